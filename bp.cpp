@@ -2,7 +2,17 @@
 /* This file should hold your implementation of the predictor simulator */
 
 #include <vector>
+#include <algorithm>
+#include <stdexcept>
 #include <assert.h>
+#include <string.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <immintrin.h>
+#define PERCEPTRON_X86_KERNELS 1
+#define PERCEPTRON_TARGET(isa) __attribute__((target(isa)))
+#else
+#define PERCEPTRON_X86_KERNELS 0
+#endif
 #include "bp_api.h"
 #include "stdlib.h"
 #include "math.h"
@@ -25,6 +35,14 @@ namespace helpers {
         }
         return num & mask;
     }
+
+    /**
+     * @param n - number of bits (up to 64).
+     * @return Mask with the n least significant bits set.
+     */
+    uint64_t maskOfNBits64(uint32_t n) {
+        return n >= 64 ? ~(uint64_t)0 : (((uint64_t)1 << n) - 1);
+    }
 }
 
 class BimodialStateMachine;
@@ -103,10 +121,119 @@ private:
     BimodialState state;
 };
 
+/**
+ * Interface of a branch predictor engine. The BP_* API calls are forwarded to the engine chosen at BP_init_engine.
+ */
+class BranchPredictor {
+protected:
+    Statistics stats;
+    unsigned btb_size;
+    unsigned tag_size;
+    unsigned btb_miss_num;
+    unsigned btb_evict_num;
+
+    /**
+     * @param pc - branch's pc.
+     * @return Index in BTB that the branch can be mapped to ('set' in direct mapping).
+     */
+    uint32_t getIndexByPC(uint32_t pc) {
+        // getting rid of 2 `00` of pc.
+        return helpers::extarctLastNBits(pc >> 2, helpers::log(btb_size));
+    }
+
+    /**
+     * @param pc - branch's pc.
+     * @return Tag of the branch.
+     */
+    uint32_t getTagByPC(uint32_t pc) {
+        return helpers::extarctLastNBits(pc >> 2, this->tag_size);
+    }
+
+    /**
+     * Count a flush for a branch that was found in the BTB, if it was mispredicted.
+     * @param pc - branch's pc.
+     * @param targetPc - actual target address (in case branch was taken).
+     * @param taken - true if the branch was taken, false otherwise.
+     * @param prediction - direction predicted by the predictor.
+     * @param pred_dst - target address predicted by the predictor.
+     */
+    void countFlush(uint32_t pc, uint32_t targetPc, bool taken, bool prediction, uint32_t pred_dst) {
+        // If a (branch was not taken) AND (we said it was taken, but the target was pc + 4 (which basically means
+        // "not taken", we should not flush))
+        bool should_skip_flush = (!taken && (prediction && pred_dst == pc + 4));
+        if (!should_skip_flush) {
+            stats.flush_num += (taken != prediction || (taken && (targetPc != pred_dst)));
+        }
+    }
+
+    /**
+     * Count a branch that was not found in the BTB. It flushes the pipeline if it was taken.
+     * @param taken - true if the branch was taken, false otherwise.
+     * @param evicted - true if the branch replaced a valid record.
+     */
+    void countBtbMiss(bool taken, bool evicted) {
+        stats.flush_num += taken;
+        btb_miss_num++;
+        btb_evict_num += evicted;
+    }
+
+public:
+    /**
+     * Constructor.
+     * @param btbSize - number of records in btb.
+     * @param tagSize - number of bits in tag (in each BTB record).
+     */
+    BranchPredictor(unsigned btbSize, unsigned tagSize) : stats(Statistics{0, 0, 0}), btb_size(btbSize),
+                                                          tag_size(tagSize), btb_miss_num(0), btb_evict_num(0) {}
+
+    /**
+     * Destructor.
+     */
+    virtual ~BranchPredictor() {}
+
+    /**
+     * Predicts branch's behaviour.
+     * @param pc - branch's pc.
+     * @param dst - pointer to location to write the predicted target address (pc + 4 if not taken).
+     * @return True if the branch is predicted taken, false otherwise.
+     */
+    virtual bool predict(uint32_t pc, uint32_t *dst) = 0;
+
+    /**
+     * Update branch's actual behaviour in the predictor.
+     * @param pc - branch's pc.
+     * @param targetPc - actual target address (in case branch was taken).
+     * @param taken - true if the branch was taken, false otherwise.
+     * @param pred_dst - target address predicted by the predictor.
+     */
+    virtual void update(uint32_t pc, uint32_t targetPc, bool taken, uint32_t pred_dst) = 0;
+
+    /**
+     * @return Statistics about the predictor.
+     */
+    Statistics getStatistics() {
+        return this->stats;
+    }
+
+    /**
+     * @return Number of branches that were not found in the BTB.
+     */
+    unsigned getBtbMisses() {
+        return btb_miss_num;
+    }
+
+    /**
+     * @return Number of BTB misses that replaced a valid record.
+     */
+    unsigned getBtbEvictions() {
+        return btb_evict_num;
+    }
+};
+
 /**
  * Class representing the branch predictor.
  */
-class BimodialBranchPredictor {
+class BimodialBranchPredictor : public BranchPredictor {
 
     /***
      * Class representing BTB record.
@@ -215,11 +342,9 @@ class BimodialBranchPredictor {
     };
 
 private:
-    Statistics stats;
     std::vector <BBPRecord> records;
     uint32_t* ghr_ptr;
     StateMachineTablePtr global_fsm_table_ptr;
-    unsigned tag_size;
     unsigned fsm_default_state;
     int shared;
     unsigned history_size;
@@ -230,7 +355,7 @@ private:
      */
     bool branchExists(uint32_t pc){
         uint32_t index = getIndexByPC(pc);
-        uint32_t tag = helpers::extarctLastNBits(pc>>2, this->tag_size);
+        uint32_t tag = getTagByPC(pc);
 
         // Check edge case when BTB size is 1
         if (records.size() == 1){
@@ -257,22 +382,6 @@ private:
         }
     }
 
-    /**
-     * @param pc - branch's pc.
-     * @return Index in BTB that the branch can be mapped to ('set' in direct mapping).
-     */
-    uint32_t getIndexByPC(uint32_t pc){
-        // Calculate how many bits need to be extracted from pc
-        uint32_t btb_bits_size = helpers::log(records.size());
-
-        // Extract bits from pc
-        uint32_t shifted_pc = pc >> 2;  // getting rid of 2 `00` of pc.
-
-        // Calculates index to btb and extracts tag from record.
-        return helpers::extarctLastNBits(shifted_pc, btb_bits_size);
-
-    }
-
     /**
      * Compute theoretical memory size in bits.
      */
@@ -330,7 +439,7 @@ private:
         record.setValid();
 
         // Set tag
-        uint32_t tag = helpers::extarctLastNBits(pc>>2, this->tag_size);
+        uint32_t tag = getTagByPC(pc);
         record.setTag(tag);
 
         record.setTarget(targetPc);
@@ -361,7 +470,7 @@ private:
         assert(record.isValid());
 
         // Set branch tag in BTB
-        uint32_t tag = helpers::extarctLastNBits(pc>>2, this->tag_size);
+        uint32_t tag = getTagByPC(pc);
         record.setTag(tag);
 
         record.setTarget(targetPc);
@@ -387,11 +496,10 @@ public:
      * @param Shared - sharing policy (G-Share, L-Share, etc..).
      */
     BimodialBranchPredictor(unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned fsmState,
-                            bool isGlobalHist, bool isGlobalTable, int Shared) : stats(Statistics{0, 0, 0}),
+                            bool isGlobalHist, bool isGlobalTable, int Shared) : BranchPredictor(btbSize, tagSize),
                                                                                  records(std::vector<BBPRecord>(
                                                                                          btbSize)),
                                                                                  ghr_ptr(nullptr), global_fsm_table_ptr(nullptr),
-                                                                                 tag_size(tagSize),
                                                                                  fsm_default_state(fsmState), shared(Shared),history_size(historySize){
         if (isGlobalHist) {
             this->ghr_ptr = new uint32_t(0);
@@ -432,7 +540,7 @@ public:
      * @return True if the branch is taken, false otherwise. Target address will also be written to dst. In case the
      * branch is taken dst will have the target address, else pc + 4.
      */
-    bool predict(uint32_t pc, uint32_t *dst){
+    bool predict(uint32_t pc, uint32_t *dst) override {
         *dst = pc + 4;
         if(!branchExists(pc)){
             return false;
@@ -455,7 +563,7 @@ public:
      * @param taken - true if the branch was taken, false otherwise.
      * @param pred_dst - target address predicted by the predictor.
      */
-    void update(uint32_t pc, uint32_t targetPc, bool taken, uint32_t pred_dst){
+    void update(uint32_t pc, uint32_t targetPc, bool taken, uint32_t pred_dst) override {
         this->stats.br_num++;
         uint32_t index = getIndexByPC(pc);
         BBPRecord& record = records[index];
@@ -463,19 +571,13 @@ public:
             // Branch exists in the BTB
             record.setTarget(targetPc);
             BimodialStateMachine& machine = getMachineByPC(pc);
-
-            // If a (branch was not taken) AND (we said it was taken, but the target was pc + 4 (which basically means
-            // "not taken", we should not flush))
-            bool should_skip_flush = (!taken && (machine.getState() > 1 && pred_dst == pc + 4));
-            if(!should_skip_flush){
-                stats.flush_num += ((taken != (machine.getState() > 1) || (taken && (targetPc != pred_dst))));
-            }
+            countFlush(pc, targetPc, taken, machine.getState() > 1, pred_dst);
             taken ? machine.increaseState() : machine.decreaseState();
             record.updateHistory(taken, this->history_size);
         }
         else{
             // Branch does not exist in the BTB
-            stats.flush_num += taken;
+            countBtbMiss(taken, record.isValid());
             if (!record.isValid()){
                 this->insertBranchToEmptyLine(pc, targetPc);
 
@@ -495,21 +597,841 @@ public:
         }
     }
 
+};
+
+/**
+ * Dot-product and training kernels of the perceptron predictor. Weights are 16-bit lanes padded to a multiple of
+ * PERCEPTRON_LANES, history bit i selects input +1 (taken) or -1 (not taken) for weight i. On x86 the AVX2 or SSE2
+ * kernel is picked at runtime by CPU support, the scalar kernel is used elsewhere. The BP_PERCEPTRON_KERNEL
+ * environment variable (avx2 / sse2 / scalar) forces a kernel if the CPU supports it, other values fail init.
+ */
+namespace perceptron_kernels {
+    const unsigned PERCEPTRON_LANES = 16;
+    const int16_t WEIGHT_MAX = 127;
+    const int16_t WEIGHT_MIN = -128;
+
+    typedef int32_t (*DotKernel)(const int16_t* weights, uint64_t history, unsigned length);
+    typedef void (*TrainKernel)(int16_t* weights, uint64_t history, uint64_t valid, bool taken, unsigned length);
+
     /**
-     * @return Statistics about the predictor.
+     * Dot-product and training functions of one instruction set.
      */
-    Statistics getStatistics(){
-        return this->stats;
+    typedef struct {
+        DotKernel dot;
+        TrainKernel train;
+    } Kernel;
+
+    /**
+     * @param weights - weight vector.
+     * @param history - history register, bit i is the input of weight i.
+     * @param length - weight vector length (a multiple of PERCEPTRON_LANES).
+     * @return Dot product of the weights and the +1/-1 history inputs.
+     */
+    int32_t dotScalar(const int16_t* weights, uint64_t history, unsigned length) {
+        int32_t sum = 0;
+        for (unsigned i = 0; i < length; i++) {
+            sum += ((history >> i) & 1) ? weights[i] : -weights[i];
+        }
+        return sum;
+    }
+
+    /**
+     * Move every weight one step towards the outcome (up if its history bit agrees with it, down otherwise),
+     * saturating at WEIGHT_MIN / WEIGHT_MAX.
+     * @param weights - weight vector.
+     * @param history - history register, bit i is the input of weight i.
+     * @param valid - mask of the weights in use, padding weights are left at zero.
+     * @param taken - branch outcome.
+     * @param length - weight vector length (a multiple of PERCEPTRON_LANES).
+     */
+    void trainScalar(int16_t* weights, uint64_t history, uint64_t valid, bool taken, unsigned length) {
+        for (unsigned i = 0; i < length; i++) {
+            if (!((valid >> i) & 1)) {
+                continue;
+            }
+            int weight = weights[i] + ((((history >> i) & 1) == taken) ? 1 : -1);
+            weights[i] = (int16_t)(weight > WEIGHT_MAX ? WEIGHT_MAX : (weight < WEIGHT_MIN ? WEIGHT_MIN : weight));
+        }
+    }
+
+#if PERCEPTRON_X86_KERNELS
+    /**
+     * @param bits - 16 history bits.
+     * @return Vector with lane i all ones if bit i is set, zero otherwise.
+     */
+    PERCEPTRON_TARGET("avx2") inline __m256i expandBitsAvx2(uint32_t bits) {
+        const __m256i select = _mm256_setr_epi16(0x1, 0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80, 0x100, 0x200, 0x400,
+                                                 0x800, 0x1000, 0x2000, 0x4000, (int16_t)0x8000);
+        __m256i broadcast = _mm256_set1_epi16((int16_t)bits);
+        return _mm256_cmpeq_epi16(_mm256_and_si256(broadcast, select), select);
+    }
+
+    /**
+     * AVX2 version of dotScalar.
+     */
+    PERCEPTRON_TARGET("avx2") int32_t dotAvx2(const int16_t* weights, uint64_t history, unsigned length) {
+        const __m256i all_ones = _mm256_set1_epi16(-1);
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i acc = _mm256_setzero_si256();
+        for (unsigned i = 0; i < length; i += 16) {
+            __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+            // Negate the weights whose history bit is 0.
+            __m256i neg = _mm256_xor_si256(expandBitsAvx2((uint32_t)(history >> i)), all_ones);
+            __m256i x = _mm256_sub_epi16(_mm256_xor_si256(w, neg), neg);
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(x, ones));
+        }
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    /**
+     * AVX2 version of trainScalar.
+     */
+    PERCEPTRON_TARGET("avx2") void trainAvx2(int16_t* weights, uint64_t history, uint64_t valid, bool taken,
+                                          unsigned length) {
+        const __m256i all_ones = _mm256_set1_epi16(-1);
+        const __m256i ones = _mm256_set1_epi16(1);
+        const __m256i w_max = _mm256_set1_epi16(WEIGHT_MAX);
+        const __m256i w_min = _mm256_set1_epi16(WEIGHT_MIN);
+        const __m256i flip = taken ? _mm256_setzero_si256() : all_ones;
+        for (unsigned i = 0; i < length; i += 16) {
+            __m256i w = _mm256_loadu_si256((const __m256i*)(weights + i));
+            // Decrement where the history bit disagrees with the outcome, increment where it agrees.
+            __m256i bits = expandBitsAvx2((uint32_t)(history >> i));
+            __m256i neg = _mm256_xor_si256(_mm256_xor_si256(bits, all_ones), flip);
+            __m256i delta = _mm256_sub_epi16(_mm256_xor_si256(ones, neg), neg);
+            delta = _mm256_and_si256(delta, expandBitsAvx2((uint32_t)(valid >> i)));
+            w = _mm256_max_epi16(_mm256_min_epi16(_mm256_adds_epi16(w, delta), w_max), w_min);
+            _mm256_storeu_si256((__m256i*)(weights + i), w);
+        }
+    }
+
+    /**
+     * @param bits - 8 history bits.
+     * @return Vector with lane i all ones if bit i is set, zero otherwise.
+     */
+    PERCEPTRON_TARGET("sse2") inline __m128i expandBitsSse2(uint32_t bits) {
+        const __m128i select = _mm_setr_epi16(0x1, 0x2, 0x4, 0x8, 0x10, 0x20, 0x40, 0x80);
+        __m128i broadcast = _mm_set1_epi16((int16_t)bits);
+        return _mm_cmpeq_epi16(_mm_and_si128(broadcast, select), select);
+    }
+
+    /**
+     * SSE2 version of dotScalar.
+     */
+    PERCEPTRON_TARGET("sse2") int32_t dotSse2(const int16_t* weights, uint64_t history, unsigned length) {
+        const __m128i all_ones = _mm_set1_epi16(-1);
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i acc = _mm_setzero_si128();
+        for (unsigned i = 0; i < length; i += 8) {
+            __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+            // Negate the weights whose history bit is 0.
+            __m128i neg = _mm_xor_si128(expandBitsSse2((uint32_t)(history >> i)), all_ones);
+            __m128i x = _mm_sub_epi16(_mm_xor_si128(w, neg), neg);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(x, ones));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(acc);
+    }
+
+    /**
+     * SSE2 version of trainScalar.
+     */
+    PERCEPTRON_TARGET("sse2") void trainSse2(int16_t* weights, uint64_t history, uint64_t valid, bool taken,
+                                          unsigned length) {
+        const __m128i all_ones = _mm_set1_epi16(-1);
+        const __m128i ones = _mm_set1_epi16(1);
+        const __m128i w_max = _mm_set1_epi16(WEIGHT_MAX);
+        const __m128i w_min = _mm_set1_epi16(WEIGHT_MIN);
+        const __m128i flip = taken ? _mm_setzero_si128() : all_ones;
+        for (unsigned i = 0; i < length; i += 8) {
+            __m128i w = _mm_loadu_si128((const __m128i*)(weights + i));
+            // Decrement where the history bit disagrees with the outcome, increment where it agrees.
+            __m128i neg = _mm_xor_si128(_mm_xor_si128(expandBitsSse2((uint32_t)(history >> i)), all_ones), flip);
+            __m128i delta = _mm_sub_epi16(_mm_xor_si128(ones, neg), neg);
+            delta = _mm_and_si128(delta, expandBitsSse2((uint32_t)(valid >> i)));
+            w = _mm_max_epi16(_mm_min_epi16(_mm_adds_epi16(w, delta), w_max), w_min);
+            _mm_storeu_si128((__m128i*)(weights + i), w);
+        }
+    }
+#endif
+
+    /**
+     * @return Kernel to use on this CPU, honouring BP_PERCEPTRON_KERNEL. A forced kernel the CPU lacks falls back to
+     * the best supported one.
+     * @throw std::invalid_argument if BP_PERCEPTRON_KERNEL is set to an unknown kernel.
+     */
+    Kernel selectKernel() {
+        const char* forced = getenv("BP_PERCEPTRON_KERNEL");
+        if (forced && strcmp(forced, "avx2") != 0 && strcmp(forced, "sse2") != 0 && strcmp(forced, "scalar") != 0) {
+            throw std::invalid_argument("BP_PERCEPTRON_KERNEL must be avx2, sse2 or scalar");
+        }
+#if PERCEPTRON_X86_KERNELS
+        bool force_scalar = forced && strcmp(forced, "scalar") == 0;
+        bool force_sse2 = forced && strcmp(forced, "sse2") == 0;
+        __builtin_cpu_init();
+        if (!force_scalar && !force_sse2 && __builtin_cpu_supports("avx2")) {
+            return Kernel{dotAvx2, trainAvx2};
+        }
+        if (!force_scalar && __builtin_cpu_supports("sse2")) {
+            return Kernel{dotSse2, trainSse2};
+        }
+#endif
+        return Kernel{dotScalar, trainScalar};
+    }
+}
+
+/**
+ * Class representing a perceptron branch predictor. Every BTB record holds a weight vector over the history register
+ * (local per record or global), the direction is the sign of the bias plus the dot product of weights and history.
+ * The table and sharing fields of the config line do not apply to this engine.
+ */
+class PerceptronBranchPredictor : public BranchPredictor {
+
+    /***
+     * Class representing BTB record.
+     */
+    class PerceptronRecord {
+    private:
+        bool valid;
+        uint32_t tag;
+        uint32_t target;
+        uint64_t history;
+        int16_t bias;
+        std::vector<int16_t> weights;
+
+    public:
+        /**
+         * Constructor.
+         * @param n_weights - weight vector length (padded to the kernels' lane count).
+         */
+        explicit PerceptronRecord(unsigned n_weights) : valid(false), tag(0), target(0), history(0), bias(0),
+                                                        weights(n_weights, 0) {}
+
+        /**
+         * @param tag - tag to compare with.
+         * @return True if the record is valid and has the same tag as @param tag, false otherwise.
+         */
+        bool compareTag(uint32_t tag) {
+            return this->valid && tag == this->tag;
+        }
+
+        /**
+         * @return True if the record is valid, meaning the record is being used by a branch.
+         */
+        bool isValid() {
+            return this->valid;
+        }
+
+        /**
+         * Assign the record to a new branch, clearing the weights and the local history.
+         * @param tag - tag of the new branch.
+         * @param target - target address of the new branch.
+         */
+        void reset(uint32_t tag, uint32_t target) {
+            this->valid = true;
+            this->tag = tag;
+            this->target = target;
+            this->history = 0;
+            this->bias = 0;
+            std::fill(weights.begin(), weights.end(), 0);
+        }
+
+        /**
+         * @return Record's target address.
+         */
+        uint32_t getTarget() {
+            return this->target;
+        }
+
+        /**
+         * Set record's target.
+         * @param target - target to set.
+         */
+        void setTarget(uint32_t target) {
+            this->target = target;
+        }
+
+        /**
+         * @return Record's local history register.
+         */
+        uint64_t& getHistory() {
+            return this->history;
+        }
+
+        /**
+         * @return Record's bias weight.
+         */
+        int16_t& getBias() {
+            return this->bias;
+        }
+
+        /**
+         * @return Pointer to record's weight vector.
+         */
+        int16_t* getWeights() {
+            return this->weights.data();
+        }
+    };
+
+private:
+    std::vector<PerceptronRecord> records;
+    uint64_t ghr;
+    bool global_history;
+    unsigned history_size;
+    unsigned n_weights;
+    uint64_t history_mask;
+    int32_t threshold;
+    perceptron_kernels::Kernel kernel;
+
+    // Output of the last prediction, reused by the update that follows it.
+    bool cached_output_valid;
+    uint32_t cached_pc;
+    int32_t cached_output;
+
+    /**
+     * @param record - BTB record.
+     * @return History register used by the record (global or its local one).
+     */
+    uint64_t& historyOf(PerceptronRecord& record) {
+        return global_history ? this->ghr : record.getHistory();
+    }
+
+    /**
+     * @param record - BTB record.
+     * @return Perceptron output: bias plus dot product of the weights and the history.
+     */
+    int32_t computeOutput(PerceptronRecord& record) {
+        return record.getBias() + kernel.dot(record.getWeights(), historyOf(record), n_weights);
+    }
+
+    /**
+     * Train the record's perceptron with the branch outcome and shift the outcome into the history.
+     * @param record - BTB record.
+     * @param output - perceptron output computed before the outcome was known.
+     * @param taken - true if the branch was taken.
+     */
+    void train(PerceptronRecord& record, int32_t output, bool taken) {
+        uint64_t& history = historyOf(record);
+        if ((output >= 0) != taken || abs(output) <= threshold) {
+            int16_t& bias = record.getBias();
+            if (taken && bias < perceptron_kernels::WEIGHT_MAX) {
+                bias++;
+            } else if (!taken && bias > perceptron_kernels::WEIGHT_MIN) {
+                bias--;
+            }
+            kernel.train(record.getWeights(), history, history_mask, taken, n_weights);
+        }
+        history = ((history << 1) | (uint64_t)taken) & history_mask;
+    }
+
+    /**
+     * Compute theoretical memory size in bits. Weights are counted as 8 bits each.
+     */
+    void computeMemorySize() {
+        unsigned record_size = tag_size + TARGET_SIZE + (history_size + 1) * 8;
+        if (!global_history) {
+            stats.size = records.size() * (record_size + history_size);
+        } else {
+            stats.size = records.size() * record_size + history_size;
+        }
+    }
+
+public:
+    /**
+     * Constructor. Will be called from BP_init_engine.
+     * @param btbSize - number of records in btb.
+     * @param historySize - number of bits in history register (up to 64).
+     * @param tagSize - number of bits in tag (in each BTB record).
+     * @param isGlobalHist - if true, global history register will be used.
+     */
+    PerceptronBranchPredictor(unsigned btbSize, unsigned historySize, unsigned tagSize, bool isGlobalHist) :
+            BranchPredictor(btbSize, tagSize), ghr(0), global_history(isGlobalHist), history_size(historySize),
+            cached_output_valid(false), cached_pc(0), cached_output(0) {
+        if (historySize == 0 || historySize > 64) {
+            throw std::invalid_argument("perceptron history size must be between 1 and 64");
+        }
+        this->n_weights = (historySize + perceptron_kernels::PERCEPTRON_LANES - 1) /
+                          perceptron_kernels::PERCEPTRON_LANES * perceptron_kernels::PERCEPTRON_LANES;
+        this->history_mask = helpers::maskOfNBits64(historySize);
+        this->threshold = (int32_t)(1.93 * historySize + 14);
+        this->kernel = perceptron_kernels::selectKernel();
+        this->records = std::vector<PerceptronRecord>(btbSize, PerceptronRecord(n_weights));
+        this->computeMemorySize();
+    }
+
+    /**
+     * Predicts branch's behaviour.
+     * @param pc - branch's pc.
+     * @param dst - pointer to location to write the target address predicted by the predictor.
+     * @return True if the perceptron output is not negative, false otherwise or if the branch is not in the BTB.
+     * Target address will also be written to dst. In case the branch is taken dst will have the target address,
+     * else pc + 4.
+     */
+    bool predict(uint32_t pc, uint32_t *dst) override {
+        *dst = pc + 4;
+        PerceptronRecord& record = records[getIndexByPC(pc)];
+        if (!record.compareTag(getTagByPC(pc))) {
+            cached_output_valid = false;
+            return false;
+        }
+        cached_pc = pc;
+        cached_output = computeOutput(record);
+        cached_output_valid = true;
+        bool prediction = cached_output >= 0;
+        if (prediction) {
+            *dst = record.getTarget();
+        }
+        return prediction;
     }
 
+    /**
+     * Update branch's actual behaviour in the predictor.
+     * @param pc - branch's pc.
+     * @param targetPc - actual target address (in case branch was taken).
+     * @param taken - true if the branch was taken, false otherwise.
+     * @param pred_dst - target address predicted by the predictor.
+     */
+    void update(uint32_t pc, uint32_t targetPc, bool taken, uint32_t pred_dst) override {
+        this->stats.br_num++;
+        PerceptronRecord& record = records[getIndexByPC(pc)];
+        if (record.compareTag(getTagByPC(pc))) {
+            // Branch exists in the BTB
+            record.setTarget(targetPc);
+            int32_t output = (cached_output_valid && cached_pc == pc) ? cached_output : computeOutput(record);
+            bool prediction = output >= 0;
+            countFlush(pc, targetPc, taken, prediction, pred_dst);
+            train(record, output, taken);
+        } else {
+            // Branch does not exist in the BTB
+            countBtbMiss(taken, record.isValid());
+            record.reset(getTagByPC(pc), targetPc);
+            train(record, computeOutput(record), taken);
+        }
+        cached_output_valid = false;
+    }
 };
 
-BimodialBranchPredictor* predictor;
+/**
+ * Class representing a tournament branch predictor. A local-history component and a gshare component predict every
+ * branch, and a chooser table of 2-bit counters indexed by the global history picks which of them to follow.
+ * The history type field of the config line is not used, the table field applies to the local component and the
+ * sharing field selects the gshare pc bits (lsb unless using_share_mid).
+ */
+class TournamentBranchPredictor : public BranchPredictor {
 
-int BP_init(unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned fsmState,
-            bool isGlobalHist, bool isGlobalTable, int Shared) {
+    /***
+     * Class representing BTB record.
+     */
+    class TournamentRecord {
+    private:
+        bool valid;
+        uint32_t tag;
+        uint32_t target;
+        uint32_t history;
+        StateMachineTablePtr machine_table_ptr;
+
+    public:
+        /**
+         * Default constructor.
+         */
+        TournamentRecord() : valid(false), tag(0), target(0), history(0), machine_table_ptr(nullptr) {}
+
+        /**
+         * @param tag - tag to compare with.
+         * @return True if the record is valid and has the same tag as @param tag, false otherwise.
+         */
+        bool compareTag(uint32_t tag) {
+            return this->valid && tag == this->tag;
+        }
+
+        /**
+         * @return True if the record is valid, meaning the record is being used by a branch.
+         */
+        bool isValid() {
+            return this->valid;
+        }
+
+        /**
+         * Assign the record to a new branch, clearing the local history.
+         * @param tag - tag of the new branch.
+         * @param target - target address of the new branch.
+         */
+        void reset(uint32_t tag, uint32_t target) {
+            this->valid = true;
+            this->tag = tag;
+            this->target = target;
+            this->history = 0;
+        }
+
+        /**
+         * @return Record's target address.
+         */
+        uint32_t getTarget() {
+            return this->target;
+        }
+
+        /**
+         * Set record's target.
+         * @param target - target to set.
+         */
+        void setTarget(uint32_t target) {
+            this->target = target;
+        }
+
+        /**
+         * @return Record's local history register.
+         */
+        uint32_t& getHistory() {
+            return this->history;
+        }
+
+        /**
+         * @return Pointer to the local component's state machine table. Table could be per record or shared.
+         */
+        StateMachineTablePtr getStateMachineTablePtr() {
+            return this->machine_table_ptr;
+        }
+
+        /**
+         * Set record's pointer to the local component's state machine table.
+         * @param table_ptr - pointer to a new table.
+         */
+        void setStateMachineTablePtr(StateMachineTablePtr table_ptr) {
+            this->machine_table_ptr = table_ptr;
+        }
+    };
+
+private:
+    SIM_hybrid_stats hybrid_stats;
+    std::vector<TournamentRecord> records;
+    uint32_t ghr;
+    StateMachineTablePtr local_fsm_table_ptr;
+    StateMachineTable gshare_table;
+    StateMachineTable chooser_table;
+    unsigned fsm_default_state;
+    int shared;
+    unsigned history_size;
+    uint32_t history_mask;
+
+    /**
+     * @param pc - branch's pc.
+     * @return State machine of the gshare component for the branch.
+     */
+    BimodialStateMachine& getGshareMachine(uint32_t pc) {
+        uint32_t pc_bits = (this->shared == 2) ? (pc >> 15) : (pc >> 2);
+        return gshare_table[(ghr ^ pc_bits) & history_mask];
+    }
+
+    /**
+     * @param record - BTB record of the branch.
+     * @return State machine of the local component for the branch.
+     */
+    BimodialStateMachine& getLocalMachine(TournamentRecord& record) {
+        return (*record.getStateMachineTablePtr())[record.getHistory()];
+    }
+
+    /**
+     * @return Chooser counter for the current global history. Taken states select the gshare component.
+     */
+    BimodialStateMachine& getChooser() {
+        return chooser_table[ghr];
+    }
+
+    /**
+     * Train both components and the chooser with the branch outcome, then shift it into both histories.
+     * @param record - BTB record of the branch.
+     * @param pc - branch's pc.
+     * @param taken - true if the branch was taken.
+     */
+    void train(TournamentRecord& record, uint32_t pc, bool taken) {
+        BimodialStateMachine& local_machine = getLocalMachine(record);
+        BimodialStateMachine& gshare_machine = getGshareMachine(pc);
+        bool local_prediction = local_machine.getState() > 1;
+        bool gshare_prediction = gshare_machine.getState() > 1;
+        if (local_prediction != gshare_prediction) {
+            gshare_prediction == taken ? getChooser().increaseState() : getChooser().decreaseState();
+        }
+        taken ? local_machine.increaseState() : local_machine.decreaseState();
+        taken ? gshare_machine.increaseState() : gshare_machine.decreaseState();
+        record.getHistory() = ((record.getHistory() << 1) | (uint32_t)taken) & history_mask;
+        ghr = ((ghr << 1) | (uint32_t)taken) & history_mask;
+    }
+
+    /**
+     * @param historySize - number of bits in every history register.
+     * @return Number of state machines in a table indexed by the history.
+     */
+    static unsigned getTableSize(unsigned historySize) {
+        if (historySize == 0 || historySize >= 32) {
+            throw std::invalid_argument("tournament history size must be between 1 and 31");
+        }
+        return (unsigned)((uint64_t)1 << historySize);
+    }
+
+    /**
+     * @return New local state machine table initialized to the default state.
+     */
+    StateMachineTablePtr newLocalTable() {
+        return new StateMachineTable(history_mask + 1, BimodialStateMachine((BimodialStateMachine::BimodialState)fsm_default_state));
+    }
+
+    /**
+     * Compute theoretical memory size in bits: BTB with local histories, local tables (per record or shared),
+     * gshare table, global history register and chooser table.
+     */
+    void computeMemorySize() {
+        unsigned table_size = (unsigned)2 * (history_mask + 1);
+        unsigned local_tables_size = local_fsm_table_ptr ? table_size : btb_size * table_size;
+        stats.size = btb_size * (tag_size + TARGET_SIZE + history_size) + local_tables_size + table_size +
+                     history_size + table_size;
+    }
+
+public:
+    /**
+     * Constructor. Will be called from BP_init_engine.
+     * @param btbSize - number of records in btb.
+     * @param historySize - number of bits in every history register (1 to 31).
+     * @param tagSize - number of bits in tag (in each BTB record).
+     * @param fsmState - default state to initalize the component state machines.
+     * @param isGlobalTable - if true, the local component uses one state machine table shared by all records.
+     * @param Shared - 2 to index the gshare table with the mid pc bits, lsb bits otherwise.
+     */
+    TournamentBranchPredictor(unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned fsmState,
+                              bool isGlobalTable, int Shared) :
+            BranchPredictor(btbSize, tagSize), hybrid_stats(SIM_hybrid_stats{0, 0, 0, 0, 0, 0}),
+            records(std::vector<TournamentRecord>(btbSize)), ghr(0), local_fsm_table_ptr(nullptr),
+            gshare_table(getTableSize(historySize), BimodialStateMachine((BimodialStateMachine::BimodialState)fsmState)),
+            chooser_table(getTableSize(historySize), BimodialStateMachine(BimodialStateMachine::WEAKLY_NOT_TAKEN)),
+            fsm_default_state(fsmState), shared(Shared), history_size(historySize),
+            history_mask((uint32_t)helpers::maskOfNBits64(historySize)) {
+        if (isGlobalTable) {
+            this->local_fsm_table_ptr = newLocalTable();
+        }
+        this->computeMemorySize();
+    }
+
+    /**
+     * Destructor.
+     */
+    ~TournamentBranchPredictor() {
+        if (local_fsm_table_ptr) {
+            delete local_fsm_table_ptr;
+            return;
+        }
+        for (TournamentRecord& record: this->records) {
+            if (record.isValid()) {
+                delete record.getStateMachineTablePtr();
+            }
+        }
+    }
+
+    /**
+     * Predicts branch's behaviour with the component selected by the chooser.
+     * @param pc - branch's pc.
+     * @param dst - pointer to location to write the target address predicted by the predictor.
+     * @return True if the branch is predicted taken, false otherwise or if the branch is not in the BTB. Target
+     * address will also be written to dst. In case the branch is taken dst will have the target address, else pc + 4.
+     */
+    bool predict(uint32_t pc, uint32_t *dst) override {
+        *dst = pc + 4;
+        TournamentRecord& record = records[getIndexByPC(pc)];
+        if (!record.compareTag(getTagByPC(pc))) {
+            return false;
+        }
+        BimodialStateMachine& machine = getChooser().getState() > 1 ? getGshareMachine(pc) : getLocalMachine(record);
+        bool prediction = machine.getState() > 1;
+        if (prediction) {
+            *dst = record.getTarget();
+        }
+        return prediction;
+    }
+
+    /**
+     * Update branch's actual behaviour in the predictor.
+     * @param pc - branch's pc.
+     * @param targetPc - actual target address (in case branch was taken).
+     * @param taken - true if the branch was taken, false otherwise.
+     * @param pred_dst - target address predicted by the predictor.
+     */
+    void update(uint32_t pc, uint32_t targetPc, bool taken, uint32_t pred_dst) override {
+        this->stats.br_num++;
+        TournamentRecord& record = records[getIndexByPC(pc)];
+        if (record.compareTag(getTagByPC(pc))) {
+            // Branch exists in the BTB
+            record.setTarget(targetPc);
+            bool local_prediction = getLocalMachine(record).getState() > 1;
+            bool gshare_prediction = getGshareMachine(pc).getState() > 1;
+            bool use_gshare = getChooser().getState() > 1;
+            bool prediction = use_gshare ? gshare_prediction : local_prediction;
+
+            hybrid_stats.pred_num++;
+            hybrid_stats.local_correct += (local_prediction == taken);
+            hybrid_stats.global_correct += (gshare_prediction == taken);
+            hybrid_stats.chose_global += use_gshare;
+            if (local_prediction != gshare_prediction) {
+                hybrid_stats.disagree_num++;
+                hybrid_stats.chooser_correct += (prediction == taken);
+            }
+            countFlush(pc, targetPc, taken, prediction, pred_dst);
+        } else {
+            // Branch does not exist in the BTB
+            countBtbMiss(taken, record.isValid());
+            if (!local_fsm_table_ptr) {
+                if (record.isValid()) {
+                    delete record.getStateMachineTablePtr();
+                }
+                record.setStateMachineTablePtr(newLocalTable());
+            } else {
+                record.setStateMachineTablePtr(local_fsm_table_ptr);
+            }
+            record.reset(getTagByPC(pc), targetPc);
+        }
+        train(record, pc, taken);
+    }
+
+    /**
+     * @return Per-component accuracy and chooser statistics.
+     */
+    SIM_hybrid_stats getHybridStatistics() {
+        return this->hybrid_stats;
+    }
+};
+
+/**
+ * Class recording predictor statistics over fixed windows of branches. Windows are kept in a ring allocated up front,
+ * so recording does no allocation or I/O; once the ring is full the oldest windows are overwritten.
+ */
+class WindowedStatistics {
+public:
+    /**
+     * Statistics of one window. Counts are of the window only, not cumulative.
+     */
+    typedef struct {
+        uint32_t br_num;
+        uint32_t flush_num;
+        uint32_t btb_miss_num;
+        uint32_t btb_evict_num;
+    } Window;
+
+private:
+    std::vector<Window> ring;
+    unsigned window_size;
+    unsigned branches_in_window;
+    uint64_t closed_windows;
+    Window last_totals;
+
+    /**
+     * @param predictor - predictor to take the counters from.
+     * @return Cumulative counters of the predictor since BP_init.
+     */
+    static Window readTotals(BranchPredictor& predictor) {
+        Statistics stats = predictor.getStatistics();
+        return Window{stats.br_num, stats.flush_num, predictor.getBtbMisses(), predictor.getBtbEvictions()};
+    }
+
+    /**
+     * Store the current window in the ring and start a new one.
+     * @param predictor - predictor to take the cumulative counters from.
+     */
+    void closeWindow(BranchPredictor& predictor) {
+        Window totals = readTotals(predictor);
+        Window& window = ring[closed_windows % ring.size()];
+        window.br_num = totals.br_num - last_totals.br_num;
+        window.flush_num = totals.flush_num - last_totals.flush_num;
+        window.btb_miss_num = totals.btb_miss_num - last_totals.btb_miss_num;
+        window.btb_evict_num = totals.btb_evict_num - last_totals.btb_evict_num;
+        last_totals = totals;
+        closed_windows++;
+        branches_in_window = 0;
+    }
+
+public:
+    /**
+     * Constructor. The first window starts at the predictor's current counters, so branches updated before
+     * recording was enabled are not counted.
+     * @param predictor - predictor to record.
+     * @param windowSize - number of branches in a window.
+     * @param capacity - number of windows kept in the ring.
+     */
+    WindowedStatistics(BranchPredictor& predictor, unsigned windowSize, unsigned capacity) :
+            ring(capacity), window_size(windowSize), branches_in_window(0), closed_windows(0),
+            last_totals(readTotals(predictor)) {
+        if (windowSize == 0 || capacity == 0) {
+            throw std::invalid_argument("window size and capacity must be positive");
+        }
+    }
+
+    /**
+     * Account for one updated branch. Called from BP_update.
+     * @param predictor - predictor that was updated.
+     */
+    void onBranch(BranchPredictor& predictor) {
+        if (++branches_in_window == window_size) {
+            closeWindow(predictor);
+        }
+    }
+
+    /**
+     * Close the last, partial window and write the kept windows to a stream.
+     * CSV has a header line and one line per window. Binary is a header of window size (uint32), window count
+     * (uint32) and first window index (uint64), followed by the windows as 4 uint32 fields, in host byte order.
+     * @param predictor - predictor the windows were recorded on.
+     * @param out - stream to write to.
+     * @param binary - true for binary output, false for CSV.
+     * @return True on success, false if writing failed.
+     */
+    bool dump(BranchPredictor& predictor, FILE* out, bool binary) {
+        if (branches_in_window > 0) {
+            closeWindow(predictor);
+        }
+        uint64_t first_window = closed_windows > ring.size() ? closed_windows - ring.size() : 0;
+        uint32_t count = (uint32_t)(closed_windows - first_window);
+        if (binary) {
+            uint32_t header[2] = {window_size, count};
+            if (fwrite(header, sizeof(header), 1, out) != 1 || fwrite(&first_window, sizeof(first_window), 1, out) != 1) {
+                return false;
+            }
+        } else if (fprintf(out, "window,br_num,flush_num,btb_miss_num,btb_evict_num\n") < 0) {
+            return false;
+        }
+        for (uint64_t i = first_window; i < closed_windows; i++) {
+            Window& window = ring[i % ring.size()];
+            if (binary) {
+                if (fwrite(&window, sizeof(window), 1, out) != 1) {
+                    return false;
+                }
+            } else if (fprintf(out, "%llu,%u,%u,%u,%u\n", (unsigned long long)i, window.br_num, window.flush_num,
+                               window.btb_miss_num, window.btb_evict_num) < 0) {
+                return false;
+            }
+        }
+        return fflush(out) == 0;
+    }
+};
+
+BranchPredictor* predictor = nullptr;
+WindowedStatistics* window_stats = nullptr;
+
+int BP_init_engine(BP_engine engine, unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned fsmState,
+                   bool isGlobalHist, bool isGlobalTable, int Shared) {
     try{
-        predictor = new BimodialBranchPredictor(btbSize, historySize, tagSize, fsmState, isGlobalHist, isGlobalTable, Shared);
+        switch (engine) {
+            case BP_ENGINE_BIMODIAL:
+                predictor = new BimodialBranchPredictor(btbSize, historySize, tagSize, fsmState, isGlobalHist, isGlobalTable, Shared);
+                break;
+            case BP_ENGINE_PERCEPTRON:
+                predictor = new PerceptronBranchPredictor(btbSize, historySize, tagSize, isGlobalHist);
+                break;
+            case BP_ENGINE_TOURNAMENT:
+                predictor = new TournamentBranchPredictor(btbSize, historySize, tagSize, fsmState, isGlobalTable, Shared);
+                break;
+            default:
+                return -1;
+        }
     }
     catch (...){
         return -1;
@@ -518,16 +1440,62 @@ int BP_init(unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned f
     return 0;
 }
 
+int BP_init(unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned fsmState,
+            bool isGlobalHist, bool isGlobalTable, int Shared) {
+    return BP_init_engine(BP_ENGINE_BIMODIAL, btbSize, historySize, tagSize, fsmState, isGlobalHist, isGlobalTable, Shared);
+}
+
 bool BP_predict(uint32_t pc, uint32_t *dst) {
     return predictor->predict(pc, dst);
 }
 
 void BP_update(uint32_t pc, uint32_t targetPc, bool taken, uint32_t pred_dst) {
     predictor->update(pc, targetPc, taken, pred_dst);
+    if (window_stats) {
+        window_stats->onBranch(*predictor);
+    }
+}
+
+int BP_EnableWindowStats(unsigned windowSize, unsigned capacity) {
+    if (!predictor) {
+        return -1;
+    }
+    try{
+        delete window_stats;
+        window_stats = new WindowedStatistics(*predictor, windowSize, capacity);
+    }
+    catch (...){
+        window_stats = nullptr;
+        return -1;
+    }
+
+    return 0;
+}
+
+int BP_DumpWindowStats(FILE *out, bool binary) {
+    if (!predictor || !window_stats) {
+        return -1;
+    }
+    return window_stats->dump(*predictor, out, binary) ? 0 : -1;
+}
+
+int BP_GetHybridStats(SIM_hybrid_stats *hybridStats) {
+    if (!predictor) {
+        return -1;
+    }
+    TournamentBranchPredictor* tournament = dynamic_cast<TournamentBranchPredictor*>(predictor);
+    if (!tournament) {
+        return -1;
+    }
+    *hybridStats = tournament->getHybridStatistics();
+    return 0;
 }
 
 void BP_GetStats(SIM_stats *curStats) {
     *curStats = predictor->getStatistics();
     delete predictor;
+    predictor = nullptr;
+    delete window_stats;
+    window_stats = nullptr;
 }
 
@@ -10,6 +10,7 @@ extern "C" {
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 
 /* A structure to return information about the currect simulator state */
 typedef struct {
@@ -18,6 +19,23 @@ typedef struct {
 	unsigned size;		      // Theoretical allocated BTB and branch predictor size
 } SIM_stats;
 
+/* Predictor engines, selected by the optional 8th field of the trace config line */
+typedef enum {
+	BP_ENGINE_BIMODIAL = 0,       // 2-bit state machine tables (default)
+	BP_ENGINE_PERCEPTRON = 1,     // Perceptron over the history register (up to 64 bits)
+	BP_ENGINE_TOURNAMENT = 2      // Local-history and gshare components with a chooser table
+} BP_engine;
+
+/* Component and chooser statistics of the tournament engine */
+typedef struct {
+	unsigned pred_num;            // Direction predictions made (BTB hits)
+	unsigned local_correct;       // Correct predictions of the local-history component
+	unsigned global_correct;      // Correct predictions of the gshare component
+	unsigned chose_global;        // Predictions where the chooser selected the gshare component
+	unsigned disagree_num;        // Predictions where the components disagreed
+	unsigned chooser_correct;     // Disagreements where the chooser selected the correct component
+} SIM_hybrid_stats;
+
 /*************************************************************************/
 /* The following functions should be implemented in your bp.c (or .cpp) */
 /*************************************************************************/
@@ -30,6 +48,14 @@ typedef struct {
 int BP_init(unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned fsmState,
 bool isGlobalHist, bool isGlobalTable, int Shared);
 
+/*
+ * BP_init_engine - initialize the predictor with the given engine
+ * BP_init is BP_init_engine with BP_ENGINE_BIMODIAL
+ * return 0 on success, otherwise (init failure) return <0
+ */
+int BP_init_engine(BP_engine engine, unsigned btbSize, unsigned historySize, unsigned tagSize, unsigned fsmState,
+bool isGlobalHist, bool isGlobalTable, int Shared);
+
 /*
  * BP_predict - returns the predictor's prediction (taken / not taken) and predicted target address
  * param[in] pc - the branch instruction address
@@ -47,6 +73,32 @@ bool BP_predict(uint32_t pc, uint32_t *dst);
  */
 void BP_update(uint32_t pc, uint32_t targetPc, bool taken, uint32_t pred_dst);
 
+/*
+ * BP_EnableWindowStats - record flush_num, BTB misses and BTB evictions over windows of windowSize branches
+ * the last capacity windows are kept in a ring allocated here, so BP_update does no I/O; call after BP_init
+ * recording starts from the current counters, calling it again drops the windows recorded so far
+ * return 0 on success, <0 otherwise
+ */
+int BP_EnableWindowStats(unsigned windowSize, unsigned capacity);
+
+/*
+ * BP_DumpWindowStats - write the recorded windows (including the last, partial one) to out
+ * param[in] binary - false for CSV, true for raw records
+ * CSV: a "window,br_num,flush_num,btb_miss_num,btb_evict_num" header line, then one line per window
+ * binary, in host byte order: a 16-byte header of uint32 window size, uint32 window count and uint64 index
+ * of the first window kept, then per window 4 uint32 fields: br_num, flush_num, btb_miss_num, btb_evict_num
+ * must be called before BP_GetStats
+ * return 0 on success, <0 if window stats are not enabled, the predictor was already released or writing failed
+ */
+int BP_DumpWindowStats(FILE *out, bool binary);
+
+/*
+ * BP_GetHybridStats: Return the tournament engine component stats using a pointer
+ * must be called before BP_GetStats
+ * return 0 on success, <0 if the predictor is not a tournament engine or was already released
+ */
+int BP_GetHybridStats(SIM_hybrid_stats *hybridStats);
+
 /*
  * BP_GetStats: Return the simulator stats using a pointer
  * curStats: The returned current simulator state (only after BP_update)
@@ -1,6 +1,7 @@
 /* 046267 Computer Architecture - Winter 2019/20 - HW #1 */
 /* Main program                  					 	 */
 /* Usage: ./bp_main <trace filename>  				 	 */
+/*        [-w <window size> [-r <windows kept>] [-o <file> [-b]]]	 */
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -9,11 +10,62 @@
 
 #include "bp_api.h"
 
+/* Parses a positive number into *value, returns false if str is not one */
+static bool parsePositive(const char *str, unsigned *value) {
+	char *end;
+	if (str[0] < '0' || str[0] > '9') {
+		return false;
+	}
+	unsigned long parsed = strtoul(str, &end, 0);
+	if (*end != '\0' || parsed == 0 || parsed > 0xFFFFFFFFUL) {
+		return false;
+	}
+	*value = (unsigned) parsed;
+	return true;
+}
+
+static void usage(const char *prog) {
+	fprintf(stderr, "Usage: %s <trace filename> [-w <window size> [-r <windows kept>] [-o <file> [-b]]]\n", prog);
+	exit(1);
+}
+
 int main(int argc, char **argv) {
 
 	if (argc < 2) {
-		fprintf(stderr, "Usage: %s <trace filename>\n", argv[0]);
-		exit(1);
+		usage(argv[0]);
+	}
+
+	/* Optional windowed stats: -w window size in branches, -r ring capacity in windows,
+	 * -o output file (default stderr), -b binary output instead of CSV (requires -o) */
+	unsigned windowSize = 0;
+	unsigned windowCapacity = 4096;
+	bool hasWindowCapacity = false;
+	const char *windowFile = NULL;
+	bool windowBinary = false;
+	int arg;
+	for (arg = 2; arg < argc; ++arg) {
+		if (strcmp(argv[arg], "-w") == 0 && arg + 1 < argc) {
+			if (!parsePositive(argv[++arg], &windowSize)) {
+				usage(argv[0]);
+			}
+		} else if (strcmp(argv[arg], "-r") == 0 && arg + 1 < argc) {
+			if (!parsePositive(argv[++arg], &windowCapacity)) {
+				usage(argv[0]);
+			}
+			hasWindowCapacity = true;
+		} else if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc) {
+			windowFile = argv[++arg];
+		} else if (strcmp(argv[arg], "-b") == 0) {
+			windowBinary = true;
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (windowSize == 0 && (hasWindowCapacity || windowFile || windowBinary)) {
+		usage(argv[0]);
+	}
+	if (windowBinary && !windowFile) {
+		usage(argv[0]);
 	}
 
 	FILE *trace = fopen(argv[1], "r");
@@ -27,10 +79,10 @@ int main(int argc, char **argv) {
 		fprintf(stderr, "Error in input file: cannot read config\n");
 		exit(3);
 	}
-	char *elemnts[7];
+	char *elemnts[8];
 	int i = 0;
 	elemnts[0] = strtok(line, " ");
-	for (i = 1; i < 7; ++i) {
+	for (i = 1; i < 8; ++i) {
 		elemnts[i] = strtok(NULL, " \n");
 	}
 
@@ -72,11 +124,27 @@ int main(int argc, char **argv) {
 		exit(7);
 	}
 
-	if (BP_init(btbSize, historySize, tagSize,fsmState, isGlobalHist,
+	BP_engine engine;
+	if (elemnts[7] == NULL || strcmp(elemnts[7], "bimodial") == 0) {
+		engine = BP_ENGINE_BIMODIAL;
+	} else if (strcmp(elemnts[7], "perceptron") == 0) {
+		engine = BP_ENGINE_PERCEPTRON;
+	} else if (strcmp(elemnts[7], "tournament") == 0) {
+		engine = BP_ENGINE_TOURNAMENT;
+	} else {
+		fprintf(stderr, "Error in input file: cannot read config\n");
+		exit(10);
+	}
+
+	if (BP_init_engine(engine, btbSize, historySize, tagSize,fsmState, isGlobalHist,
 			isGlobalTable, Shared) < 0) {
 		fprintf(stderr, "Predictor init failed\n");
 		exit(8);
 	}
+	if (windowSize > 0 && BP_EnableWindowStats(windowSize, windowCapacity) < 0) {
+		fprintf(stderr, "Window stats init failed\n");
+		exit(8);
+	}
 
 	while ((fgets(line, 256, trace) != NULL)) {
 		if (line[0] == '\n') {
@@ -108,9 +176,29 @@ int main(int argc, char **argv) {
 		BP_update(pc, targetPc, taken, dst);
 	}
 
+	if (windowSize > 0) {
+		FILE *windowOut = windowFile ? fopen(windowFile, windowBinary ? "wb" : "w") : stderr;
+		if (windowOut == 0 || BP_DumpWindowStats(windowOut, windowBinary) < 0) {
+			fprintf(stderr, "cannot write window stats\n");
+			exit(11);
+		}
+		if (windowFile) {
+			fclose(windowOut);
+		}
+	}
+
+	SIM_hybrid_stats hybrid_stats;
+	bool has_hybrid_stats = (BP_GetHybridStats(&hybrid_stats) == 0);
+
 	SIM_stats stats;
 	BP_GetStats(&stats);
 	printf("flush_num: %d, br_num: %d, size: %db\n", stats.flush_num, stats.br_num, stats.size);
+	if (has_hybrid_stats) {
+		printf("local_correct: %d/%d, global_correct: %d/%d, chose_global: %d, chooser_correct: %d/%d\n",
+				hybrid_stats.local_correct, hybrid_stats.pred_num, hybrid_stats.global_correct,
+				hybrid_stats.pred_num, hybrid_stats.chose_global, hybrid_stats.chooser_correct,
+				hybrid_stats.disagree_num);
+	}
 
 	return 0;
 }
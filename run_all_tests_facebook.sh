@@ -4,4 +4,19 @@ for filename in tests/test*.in; do
     dos2unix ${filename}
     ./bp_main $filename > ${test_num}Yours.out
     diff ${test_num}.out ${test_num}Yours.out
-done
\ No newline at end of file
+done
+
+# Examples, run with every perceptron kernel (kernels the CPU lacks fall back to the best supported one)
+for kernel in avx2 sse2 scalar; do
+    for filename in input_examples/example*.trc; do
+        example_num=`echo $filename | cut -d'.' -f1`
+        BP_PERCEPTRON_KERNEL=$kernel ./bp_main $filename > ${example_num}Yours.out 2>&1
+        diff ${example_num}.out ${example_num}Yours.out
+    done
+done
+
+# Windowed stats: CSV with a wrapped ring and a partial last window, and a binary dump
+./bp_main input_examples/example11.trc -w 7 -r 3 -o input_examples/example11.windowsYours.csv > /dev/null
+diff input_examples/example11.windows.csv input_examples/example11.windowsYours.csv
+./bp_main input_examples/example11.trc -w 7 -o input_examples/example11.windowsYours.bin -b > /dev/null
+cmp input_examples/example11.windows.bin input_examples/example11.windowsYours.bin